@@ -0,0 +1,14 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "light_bank.h"
+
+// Board description: everything pin-related lives here.
+// ESP32-WROOM-32 dev board, relays/LEDs on GPIO 2, 4, 5 and 18.
+// To use another board, change the pin list (max 32 channels).
+
+#define LED 2  // On-board LED
+
+typedef LightBank<2, 4, 5, 18> BoardLights;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef BODY_HELPER_H
+#define BODY_HELPER_H
+
+#include <ESPAsyncWebServer.h>
+#include <functional>
+#include "config.h"
+#include "body_pool.h"
+#include "trace.h"
+#include "log_helper.h"
+
+// Request bodies can arrive in several chunks. assembleBody() wraps a
+// handler so it only runs once, with the whole body. Bodies that fit in one
+// chunk are passed straight through; larger ones are collected in a
+// BodyPool buffer. Over BODY_MAX_SIZE gets 413, an empty pool gets 503.
+
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t)> BodyHandler;
+
+BodyPool<BODY_POOL_SLOTS, BODY_MAX_SIZE> bodyPool;
+
+ArBodyHandlerFunction assembleBody(BodyHandler onBody) {
+  return [onBody](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    const uint8_t *body = nullptr;
+    TRACE_BEGIN("body.assemble");
+    BodyResult result = bodyPool.feed(request, data, len, index, total, &body);
+    TRACE_END("body.assemble");
+    switch (result) {
+      case BODY_PENDING:
+        // Give the buffer back if the client goes away mid-body
+        if (index == 0) request->onDisconnect([request]() { bodyPool.release(request); });
+        break;
+      case BODY_COMPLETE:
+        onBody(request, (uint8_t *)body, total);
+        bodyPool.release(request);
+        break;
+      case BODY_TOO_LARGE:
+        request->send(413, "application/json", "{\"error\": \"Body too large\"}");
+        break;
+      case BODY_BUSY:
+        LOG_W("Body pool full, rejecting %u byte body", (unsigned)total);
+        request->send(503, "application/json", "{\"error\": \"Server busy\"}");
+        break;
+      case BODY_MALFORMED:
+        request->send(400, "application/json", "{\"error\": \"Malformed body\"}");
+        break;
+      case BODY_IGNORED:
+        break;
+    }
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef BODY_POOL_H
+#define BODY_POOL_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Collects a request body that arrives in chunks into one of a fixed
+// number of buffers. The owner is an opaque pointer (the request), so this
+// has no web server dependencies and also builds on Linux.
+
+enum BodyResult {
+  BODY_PENDING,    // chunk stored, more to come
+  BODY_COMPLETE,   // *body holds the whole body; call release() when done
+  BODY_TOO_LARGE,  // total over MaxSize (first chunk only)
+  BODY_BUSY,       // no free buffer (first chunk only)
+  BODY_MALFORMED,  // chunk out of order or past total; buffer released
+  BODY_IGNORED,    // later chunk of a body that was already rejected
+};
+
+template <size_t Slots, size_t MaxSize>
+class BodyPool {
+public:
+  BodyResult feed(const void *owner, const uint8_t *data, size_t len, size_t index, size_t total,
+                  const uint8_t **body) {
+    if (total > MaxSize) return index == 0 ? BODY_TOO_LARGE : BODY_IGNORED;
+
+    // Whole body in one chunk, nothing to copy
+    if (index == 0 && len == total) {
+      *body = data;
+      return BODY_COMPLETE;
+    }
+
+    Slot *slot = find(owner);
+    if (index == 0) {
+      if (!slot) slot = claim(owner);
+      if (!slot) return BODY_BUSY;
+      slot->received = 0;
+    } else if (!slot) {
+      return BODY_IGNORED;
+    }
+
+    if (index != slot->received || len > total - index) {
+      releaseSlot(slot);
+      return BODY_MALFORMED;
+    }
+    memcpy(slot->data + index, data, len);
+    slot->received += len;
+    if (slot->received < total) return BODY_PENDING;
+
+    *body = slot->data;
+    return BODY_COMPLETE;
+  }
+
+  // Give back the buffer held for `owner`, if any. Safe to call twice.
+  void release(const void *owner) {
+    Slot *slot = find(owner);
+    if (slot) releaseSlot(slot);
+  }
+
+  size_t inUse() const {
+    size_t n = 0;
+    for (size_t i = 0; i < Slots; ++i) n += slots[i].busy.load(std::memory_order_relaxed);
+    return n;
+  }
+
+private:
+  struct Slot {
+    std::atomic<bool> busy{false};
+    const void *owner = nullptr;
+    size_t received = 0;
+    uint8_t data[MaxSize];
+  };
+
+  Slot *claim(const void *owner) {
+    for (size_t i = 0; i < Slots; ++i) {
+      bool expected = false;
+      if (slots[i].busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        slots[i].owner = owner;
+        return &slots[i];
+      }
+    }
+    return nullptr;
+  }
+
+  Slot *find(const void *owner) {
+    for (size_t i = 0; i < Slots; ++i) {
+      if (slots[i].busy.load(std::memory_order_acquire) && slots[i].owner == owner) return &slots[i];
+    }
+    return nullptr;
+  }
+
+  void releaseSlot(Slot *slot) {
+    slot->owner = nullptr;
+    slot->busy.store(false, std::memory_order_release);
+  }
+
+  Slot slots[Slots];
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded lock-free queue: any number of producers, one consumer.
+// Each slot carries a sequence number so producers only contend on the
+// tail index and never wait on each other. No Arduino dependencies, so
+// it also builds on Linux.
+template <typename T, size_t N>
+class CommandQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "CommandQueue size must be a power of two");
+
+public:
+  CommandQueue() {
+    for (size_t i = 0; i < N; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // Returns false when the queue is full. Never blocks.
+  bool push(const T &item) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = slots[pos & (N - 1)];
+      size_t seq = slot.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.data = item;
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Single consumer only. Returns false when empty.
+  bool pop(T &item) {
+    Slot &slot = slots[head & (N - 1)];
+    size_t seq = slot.seq.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(head + 1) < 0) return false;
+    item = slot.data;
+    slot.seq.store(head + N, std::memory_order_release);
+    ++head;
+    return true;
+  }
+
+  size_t capacity() const { return N; }
+
+private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  Slot slots[N];
+  std::atomic<size_t> tail{0};
+  size_t head = 0;  // owned by the consumer
+};
+
+#endif
@@ -1,9 +1,39 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#define LED 2
-#define MAX_LIGHTS 4
+#include "board.h"
+
+#define MAX_LIGHTS BoardLights::count  // Pins are listed in board.h
 extern const char* device_name;
 extern int NUM_LIGHTS;
 
+// Output task (owns the light pins)
+#define OUTPUT_QUEUE_SIZE 16
+#define OUTPUT_TASK_STACK 4096
+#define OUTPUT_TASK_PRIORITY 3
+#define OUTPUT_TASK_CORE 1
+
+// Hot-path tracing (see trace.h), dumped at /trace
+#define ENABLE_TRACE 0
+#define TRACE_BUFFER_EVENTS 512
+
+// Logging (see log_helper.h): 0 none, 1 error, 2 warn, 3 info, 4 debug
+#define LOG_LEVEL 3
+#define LOG_STREAM 1          // Also stream logs at /logs
+#define LOG_HISTORY_LINES 32  // Lines kept for /logs
+#define LOG_QUEUE_SIZE 32
+#define LOG_LINE_MAX 96
+#define LOG_FLUSH_MS 20
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY 1
+#define LOG_TASK_CORE 0
+
+// JSON request bodies (see body_helper.h)
+#define BODY_MAX_SIZE 2048
+#define BODY_POOL_SLOTS 4
+
+// Power management (see power_helper.h), budget can be changed at /power
+#define POWER_DEFAULT_BUDGET_MS 50
+#define LOOP_IDLE_MS 20       // loop() sleeps this long so the idle task can run
+
 #endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef GPIO_OUT_H
+#define GPIO_OUT_H
+
+#include <stdint.h>
+
+// The four GPIO output set/clear registers light_bank.h stores to. On the
+// ESP32 these are the real registers; on a host build they land in an
+// array so the bank logic can be tested and benchmarked on Linux.
+
+#if defined(ESP_PLATFORM)
+
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
+
+#define GPIO_OUT_SET(bits) REG_WRITE(GPIO_OUT_W1TS_REG, bits)    // GPIO 0-31
+#define GPIO_OUT_CLEAR(bits) REG_WRITE(GPIO_OUT_W1TC_REG, bits)
+#define GPIO_OUT1_SET(bits) REG_WRITE(GPIO_OUT1_W1TS_REG, bits)  // GPIO 32-39
+#define GPIO_OUT1_CLEAR(bits) REG_WRITE(GPIO_OUT1_W1TC_REG, bits)
+
+#else
+
+enum { HOST_GPIO_OUT_SET, HOST_GPIO_OUT_CLEAR, HOST_GPIO_OUT1_SET, HOST_GPIO_OUT1_CLEAR, HOST_GPIO_REGS };
+extern volatile uint32_t hostGpioRegs[HOST_GPIO_REGS];
+
+#define GPIO_OUT_SET(bits) (hostGpioRegs[HOST_GPIO_OUT_SET] = (bits))
+#define GPIO_OUT_CLEAR(bits) (hostGpioRegs[HOST_GPIO_OUT_CLEAR] = (bits))
+#define GPIO_OUT1_SET(bits) (hostGpioRegs[HOST_GPIO_OUT1_SET] = (bits))
+#define GPIO_OUT1_CLEAR(bits) (hostGpioRegs[HOST_GPIO_OUT1_CLEAR] = (bits))
+
+#endif
+
+#endif
\ No newline at end of file
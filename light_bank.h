@@ -0,0 +1,116 @@
+#ifndef LIGHT_BANK_H
+#define LIGHT_BANK_H
+
+#include <stdint.h>
+#include "gpio_out.h"
+
+// Compile-time description of the light outputs:
+//
+//   typedef LightBank<2, 4, 5, 18> BoardLights;   // channel 0 = GPIO 2, ...
+//
+// Pins are checked when the sketch compiles, and each channel's bit in the
+// GPIO output registers is worked out ahead of time, so set() is a single
+// W1TS/W1TC register store and write() turns any set of channel changes
+// into at most one set and one clear store per register.
+// Pin rules are for the original ESP32 (ESP32-WROOM/WROVER).
+
+namespace light_bank {
+
+template <uint8_t Pin>
+struct CheckPin {
+  static_assert(Pin <= 39, "GPIO number out of range for ESP32");
+  static_assert(Pin < 6 || Pin > 11, "GPIO 6-11 are wired to the SPI flash");
+  static_assert(Pin < 34, "GPIO 34-39 are input-only");
+  static_assert(Pin != 20 && Pin != 24 && (Pin < 28 || Pin > 31), "GPIO does not exist on ESP32");
+  static constexpr bool ok = true;
+};
+
+template <bool... Checks>
+struct All;
+template <>
+struct All<> { static constexpr bool value = true; };
+template <bool First, bool... Rest>
+struct All<First, Rest...> { static constexpr bool value = First && All<Rest...>::value; };
+
+template <uint8_t... Pins>
+struct Masks;
+
+template <>
+struct Masks<> {
+  static constexpr uint32_t low(uint32_t) { return 0; }
+  static constexpr uint32_t high(uint32_t) { return 0; }
+  static constexpr bool contains(uint8_t) { return false; }
+  static constexpr bool unique() { return true; }
+  static constexpr bool anyHigh() { return false; }
+};
+
+// Channel bits are consumed from the bottom, one per pin
+template <uint8_t First, uint8_t... Rest>
+struct Masks<First, Rest...> {
+  // GPIO_OUT bits (GPIO 0-31) for the selected channels
+  static constexpr uint32_t low(uint32_t channels) {
+    return ((channels & 1) && First < 32 ? (1u << (First & 31)) : 0) | Masks<Rest...>::low(channels >> 1);
+  }
+  // GPIO_OUT1 bits (GPIO 32-33) for the selected channels
+  static constexpr uint32_t high(uint32_t channels) {
+    return ((channels & 1) && First >= 32 ? (1u << (First & 31)) : 0) | Masks<Rest...>::high(channels >> 1);
+  }
+  static constexpr bool contains(uint8_t pin) { return First == pin || Masks<Rest...>::contains(pin); }
+  static constexpr bool unique() { return !Masks<Rest...>::contains(First) && Masks<Rest...>::unique(); }
+  static constexpr bool anyHigh() { return First >= 32 || Masks<Rest...>::anyHigh(); }
+};
+
+}  // namespace light_bank
+
+template <uint8_t... Pins>
+struct LightBank {
+  enum { count = sizeof...(Pins) };
+
+  static_assert(count >= 1 && count <= 32, "LightBank needs 1 to 32 pins");
+  static_assert(light_bank::All<light_bank::CheckPin<Pins>::ok...>::value, "invalid light pin");
+  static_assert(light_bank::Masks<Pins...>::unique(), "LightBank pins must be unique");
+
+  static const uint8_t pins[sizeof...(Pins)];
+
+  // Register bit of each channel: GPIO_OUT for GPIO 0-31, GPIO_OUT1 for 32/33
+  static constexpr uint32_t lowBit[sizeof...(Pins)] = {(Pins < 32 ? 1u << (Pins & 31) : 0u)...};
+  static constexpr uint32_t highBit[sizeof...(Pins)] = {(Pins >= 32 ? 1u << (Pins & 31) : 0u)...};
+
+  // Register bits for a set of channels (bit i = channel i)
+  static constexpr uint32_t lowMask(uint32_t channels) { return light_bank::Masks<Pins...>::low(channels); }
+  static constexpr uint32_t highMask(uint32_t channels) { return light_bank::Masks<Pins...>::high(channels); }
+
+  // Drive one channel. Pins must already be outputs. Exactly one store.
+  static inline void set(uint8_t channel, bool state) {
+    if (light_bank::Masks<Pins...>::anyHigh() && highBit[channel]) {
+      if (state) GPIO_OUT1_SET(highBit[channel]);
+      else GPIO_OUT1_CLEAR(highBit[channel]);
+    } else {
+      if (state) GPIO_OUT_SET(lowBit[channel]);
+      else GPIO_OUT_CLEAR(lowBit[channel]);
+    }
+  }
+
+  // Drive the selected channels to the matching bits of `states`. Pins must
+  // already be outputs. At most one set and one clear store per register;
+  // registers with nothing to change are not written.
+  static inline void write(uint32_t channels, uint32_t states) {
+    uint32_t on = channels & states;
+    uint32_t off = channels & ~states;
+    if (lowMask(on)) GPIO_OUT_SET(lowMask(on));
+    if (lowMask(off)) GPIO_OUT_CLEAR(lowMask(off));
+    if (light_bank::Masks<Pins...>::anyHigh()) {
+      if (highMask(on)) GPIO_OUT1_SET(highMask(on));
+      if (highMask(off)) GPIO_OUT1_CLEAR(highMask(off));
+    }
+  }
+};
+
+template <uint8_t... Pins>
+const uint8_t LightBank<Pins...>::pins[sizeof...(Pins)] = {Pins...};
+template <uint8_t... Pins>
+constexpr uint32_t LightBank<Pins...>::lowBit[sizeof...(Pins)];
+template <uint8_t... Pins>
+constexpr uint32_t LightBank<Pins...>::highBit[sizeof...(Pins)];
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef LIGHT_COMMAND_H
+#define LIGHT_COMMAND_H
+
+#include <stdint.h>
+
+// One queued light change, handler -> outputTask. No Arduino dependencies,
+// so the host benchmarks use the real layout.
+struct LightCommand {
+  uint8_t light;
+  bool state;
+  bool save;
+  uint32_t startUs;  // When the request headers were parsed, for latency stats
+};
+
+#endif
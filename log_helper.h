@@ -0,0 +1,167 @@
+#ifndef LOG_HELPER_H
+#define LOG_HELPER_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <stdarg.h>
+#include <string.h>
+#include "config.h"
+#include "command_queue.h"
+#include "trace.h"
+
+// Buffered logging. LOG_E/W/I/D format into a fixed record and push it onto
+// a lock-free queue; logTask drains it to Serial and into a short history
+// that /logs streams from. Calls above LOG_LEVEL compile to nothing. A full
+// queue drops the message and counts it, the caller never waits on the UART.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+struct LogRecord {
+  uint32_t ms;
+  uint8_t level;
+  char text[LOG_LINE_MAX];
+};
+
+CommandQueue<LogRecord, LOG_QUEUE_SIZE> logQueue;
+std::atomic<uint32_t> logDropped{0};
+uint32_t logCallNs = 0;  // cost of one log call, measured in startLogTask()
+
+#if LOG_STREAM
+// Last LOG_HISTORY_LINES lines for /logs. logTask writes, the AsyncTCP
+// task reads; the spinlock only covers copying one record.
+LogRecord logHistory[LOG_HISTORY_LINES];
+uint32_t logHistoryNext = 0;  // sequence number of the next line
+portMUX_TYPE logHistoryLock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+void logWrite(uint8_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void logWrite(uint8_t level, const char *fmt, ...) {
+  LogRecord rec;
+  rec.ms = millis();
+  rec.level = level;
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(rec.text, sizeof(rec.text), fmt, args);
+  va_end(args);
+  if (!logQueue.push(rec)) logDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+#define LOG_AT(level, ...) do { if ((level) <= LOG_LEVEL) logWrite(level, __VA_ARGS__); } while (0)
+#define LOG_E(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_W(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_I(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_D(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+const char logLevelChars[] = "-EWID";
+
+void logEmit(uint32_t ms, uint8_t level, const char *text) {
+  TRACE_BEGIN("serial.print");
+  Serial.printf("[%lu] %c %s\n", (unsigned long)ms, logLevelChars[level], text);
+  TRACE_END("serial.print");
+#if LOG_STREAM
+  portENTER_CRITICAL(&logHistoryLock);
+  LogRecord &rec = logHistory[logHistoryNext % LOG_HISTORY_LINES];
+  rec.ms = ms;
+  rec.level = level;
+  strlcpy(rec.text, text, sizeof(rec.text));
+  ++logHistoryNext;
+  portEXIT_CRITICAL(&logHistoryLock);
+#endif
+}
+
+void logTask(void *) {
+  uint32_t reportedDrops = 0;
+  LogRecord rec;
+  for (;;) {
+    while (logQueue.pop(rec)) logEmit(rec.ms, rec.level, rec.text);
+
+    uint32_t drops = logDropped.load(std::memory_order_relaxed);
+    if (drops != reportedDrops) {
+      char text[48];
+      snprintf(text, sizeof(text), "%lu log messages dropped", (unsigned long)(drops - reportedDrops));
+      logEmit(millis(), LOG_LEVEL_WARN, text);
+      reportedDrops = drops;
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_FLUSH_MS));
+  }
+}
+
+// Time a typical log call (format + push) before the task starts, then
+// throw the test records away.
+void logCalibrate() {
+  const int batch = LOG_QUEUE_SIZE / 2;
+  const int batches = 8;
+  uint32_t cycles = 0;
+  LogRecord rec;
+  for (int b = 0; b < batches; ++b) {
+    uint32_t start = ESP.getCycleCount();
+    for (int i = 0; i < batch; ++i) logWrite(LOG_LEVEL_INFO, "Light %d (%s): %s", i, "Light 1", "ON");
+    cycles += ESP.getCycleCount() - start;
+    while (logQueue.pop(rec)) {}
+  }
+  logCallNs = (uint64_t)cycles * 1000 / getCpuFrequencyMhz() / (batch * batches);
+}
+
+void startLogTask() {
+  logCalibrate();
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, NULL, LOG_TASK_CORE);
+  LOG_I("Log call takes %lu ns", (unsigned long)logCallNs);
+}
+
+#if LOG_STREAM
+// Fill a /logs chunk with the lines after `cursor`. Runs on the AsyncTCP
+// task, so the web server's own state is never touched from logTask.
+size_t logStreamFill(uint32_t &cursor, uint8_t *buf, size_t maxLen) {
+  size_t out = 0;
+  for (;;) {
+    LogRecord rec;
+    bool have = false;
+    portENTER_CRITICAL(&logHistoryLock);
+    if (logHistoryNext - cursor > LOG_HISTORY_LINES) cursor = logHistoryNext - LOG_HISTORY_LINES;  // fell behind
+    if (cursor != logHistoryNext) {
+      rec = logHistory[cursor % LOG_HISTORY_LINES];
+      have = true;
+    }
+    portEXIT_CRITICAL(&logHistoryLock);
+    if (!have) break;
+
+    char line[LOG_LINE_MAX + 24];
+    size_t n = snprintf(line, sizeof(line), "[%lu] %c %s\n", (unsigned long)rec.ms, logLevelChars[rec.level], rec.text);
+    if (n >= sizeof(line)) n = sizeof(line) - 1;
+    if (out + n > maxLen) {
+      if (out > 0) break;
+      n = maxLen;  // tiny window, send what fits
+    }
+    memcpy(buf + out, line, n);
+    out += n;
+    ++cursor;
+  }
+  return out > 0 ? out : RESPONSE_TRY_AGAIN;  // nothing new, poll again later
+}
+#endif
+
+// /logs - live log stream (chunked text/plain, one line per message).
+// Starts with the recent history, then follows new lines until the
+// client disconnects.
+void setupLogRoutes(AsyncWebServer &server) {
+#if LOG_STREAM
+  server.on("/logs", HTTP_GET, [](AsyncWebServerRequest *request) {
+    portENTER_CRITICAL(&logHistoryLock);
+    uint32_t cursor = logHistoryNext > LOG_HISTORY_LINES ? logHistoryNext - LOG_HISTORY_LINES : 0;
+    portEXIT_CRITICAL(&logHistoryLock);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain",
+      [cursor](uint8_t *buf, size_t maxLen, size_t) mutable -> size_t {
+        return logStreamFill(cursor, buf, maxLen);
+      });
+    request->send(response);
+  });
+#endif
+}
+
+#endif
@@ -14,15 +14,22 @@ int NUM_LIGHTS = MAX_LIGHTS;         // Default, can be overwritten by Preferenc
 AsyncWebServer server(80);
 
 void setup() {
+  // Warm restart: outputs come back from RTC memory before anything else
+  bool warmBoot = restoreLightsFromRtc();
+
   Serial.begin(115200);
+  startLogTask();
+  traceBegin();
 
   // ===== Load Config =====
   preferences.begin("config", true);
   deviceNameStr = preferences.getString("device", "esp-light");
   device_name = deviceNameStr.c_str();
 
+  configVersion = preferences.getUInt("version", 0);
   NUM_LIGHTS = preferences.getInt("numLights", MAX_LIGHTS);
-  for (int i = 0; i < NUM_LIGHTS; ++i) {
+  if (NUM_LIGHTS < 1 || NUM_LIGHTS > MAX_LIGHTS) NUM_LIGHTS = MAX_LIGHTS;  // Board may have changed
+  for (int i = 0; i < MAX_LIGHTS; ++i) {
     String key = "light" + String(i);
     String defaultName = "Light " + String(i + 1);
     lightNames[i] = preferences.getString(key.c_str(), defaultName);
@@ -30,18 +37,25 @@ void setup() {
   preferences.end();
 
   // ===== Setup pins and states =====
-  for (int i = 0; i < NUM_LIGHTS; ++i) {
-    pinMode(lightPins[i], OUTPUT);
+  // After power loss (or for lights added by /saveConfig) states come from NVS
+  int restored = warmBoot ? reconcileRtcLights() : 0;
+  for (int i = restored; i < NUM_LIGHTS; ++i) {
+    pinMode(BoardLights::pins[i], OUTPUT);
     toggleLight(i, loadLightState(i), false);  // Don’t save during boot
   }
+  releaseOutputHold();
+  saveRtcSnapshot(lightStateMask.load());
+  if (!warmBoot) bootOutputStableUs = esp_timer_get_time();
+  LOG_I("Outputs restored from %s in %lld us", bootPath, (long long)bootOutputStableUs);
+  startOutputTask();  // From here on, only the output task touches the pins
 
   delay(1000);  // Stabilize before WiFi
 
   // ===== WiFi Setup =====
   String ssid, pass;
   if (loadCredentials(ssid, pass)) {
-    Serial.println("Found saved WiFi credentials.");
-    Serial.println("SSID: " + ssid);
+    LOG_I("Found saved WiFi credentials.");
+    LOG_I("SSID: %s", ssid.c_str());
     connectToWiFi(ssid, pass);
 
     unsigned long startAttempt = millis();
@@ -51,16 +65,22 @@ void setup() {
     }
 
     if (WiFi.status() != WL_CONNECTED) {
-      Serial.println("Failed to connect. Starting AP mode...");
+      LOG_W("Failed to connect. Starting AP mode...");
       setupAP();
     }
   } else {
-    Serial.println("No saved WiFi credentials. Starting AP mode...");
+    LOG_I("No saved WiFi credentials. Starting AP mode...");
     setupAP();
   }
 
+  loadPowerConfig();
+  applyPowerMode();
+
+  server.addHandler(&requestTimer);  // First, so it sees every request
   setupWebRoutes(server);
   setupPythonRoutes(server);
+  setupTraceRoutes(server);
+  setupLogRoutes(server);
   server.begin();
 }
 
@@ -72,7 +92,7 @@ void loop() {
   if (now - lastWiFiCheck > wifiCheckInterval) {
     lastWiFiCheck = now;
     if (WiFi.getMode() == WIFI_STA && WiFi.status() != WL_CONNECTED) {
-      Serial.println("WiFi disconnected. Trying to reconnect...");
+      LOG_W("WiFi disconnected. Trying to reconnect...");
       String ssid, pass;
       if (loadCredentials(ssid, pass)) {
         connectToWiFi(ssid, pass);
@@ -81,4 +101,6 @@ void loop() {
       }
     }
   }
+
+  delay(LOOP_IDLE_MS);  // Let the idle task run (and the chip sleep)
 }
\ No newline at end of file
@@ -0,0 +1,165 @@
+#ifndef OUTPUT_TASK_H
+#define OUTPUT_TASK_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
+#include "config.h"
+#include "command_queue.h"
+#include "light_command.h"
+#include "trace.h"
+#include "rtc_state.h"
+#include "log_helper.h"
+#include "power_helper.h"
+
+extern int NUM_LIGHTS;
+extern String lightNames[MAX_LIGHTS];
+
+// Handlers push here, only outputTask pops
+CommandQueue<LightCommand, OUTPUT_QUEUE_SIZE> lightCommands;
+
+// Published light states, bit i = light i. Written only by outputTask.
+std::atomic<uint32_t> lightStateMask{0};
+
+TaskHandle_t outputTaskHandle = nullptr;
+Preferences lightPrefs;  // Only used from outputTask (and setup before it starts)
+
+void saveLightState(int i, bool state) {
+  lightPrefs.begin("light", false);
+  String key = "state" + String(i);
+  lightPrefs.putBool(key.c_str(), state);
+  lightPrefs.end();
+}
+
+bool loadLightState(int i) {
+  lightPrefs.begin("light", true);
+  String key = "state" + String(i);
+  bool state = lightPrefs.getBool(key.c_str(), false);
+  lightPrefs.end();
+  return state;
+}
+
+bool isLightOn(int i) {
+  return (lightStateMask.load(std::memory_order_acquire) >> i) & 1;
+}
+
+// Drive the pin and publish the new state. Only call from outputTask,
+// or from setup() before startOutputTask().
+void toggleLight(int i, bool state, bool save = true) {
+  BoardLights::set(i, state);
+  if (state) {
+    lightStateMask.fetch_or(1u << i, std::memory_order_release);
+  } else {
+    lightStateMask.fetch_and(~(1u << i), std::memory_order_release);
+  }
+  saveRtcSnapshot(lightStateMask.load(std::memory_order_relaxed));
+  if (save) saveLightState(i, state);
+  LOG_I("Light %d (%s): %s", i, lightNames[i].c_str(), state ? "ON" : "OFF");
+}
+
+// Warm restart: drive the outputs from the RTC snapshot before anything
+// else runs, skipping NVS. Returns false after power loss.
+bool restoreLightsFromRtc() {
+  if (!rtcSnapshotValid()) return false;
+
+  uint32_t count = rtcSnapshot.numLights;
+  uint32_t channels = count >= 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+  uint32_t mask = rtcSnapshot.lightMask & channels;
+  BoardLights::write(channels, mask);  // Set levels before enabling the outputs
+  for (uint32_t i = 0; i < count; ++i) {
+    pinMode(BoardLights::pins[i], OUTPUT);
+    gpio_hold_dis((gpio_num_t)BoardLights::pins[i]);
+  }
+  lightStateMask.store(mask, std::memory_order_release);
+  bootOutputStableUs = esp_timer_get_time();
+  bootPath = "rtc";
+
+  lastBootReason = rtcSnapshot.bootReason;
+  rtcSnapshot.bootReason = BOOT_UNKNOWN;  // A later crash shouldn't look like /restart
+  rtcSnapshot.checksum = rtcChecksum(rtcSnapshot);
+  return true;
+}
+
+// Call once the config is loaded. If /saveConfig changed it before the
+// restart, channels that are no longer configured are switched off and
+// left unconfigured, as after a cold boot. Returns how many channels keep
+// the state restored from RTC.
+int reconcileRtcLights() {
+  int restored = rtcSnapshot.numLights;
+  if (rtcSnapshot.configVersion != configVersion) {
+    LOG_I("Config changed since restart (v%lu -> v%lu)",
+          (unsigned long)rtcSnapshot.configVersion, (unsigned long)configVersion);
+    for (int i = NUM_LIGHTS; i < restored; ++i) {
+      BoardLights::set(i, false);
+      pinMode(BoardLights::pins[i], INPUT);
+      lightStateMask.fetch_and(~(1u << i), std::memory_order_release);
+    }
+  }
+  return restored < NUM_LIGHTS ? restored : NUM_LIGHTS;
+}
+
+// Safe from any task. Returns false if the index is bad or the queue is full.
+bool requestLight(int i, bool state, bool save = true, uint32_t startUs = micros()) {
+  if (i < 0 || i >= NUM_LIGHTS) return false;
+  if (!lightCommands.push({(uint8_t)i, state, save, startUs})) return false;
+  if (outputTaskHandle) xTaskNotifyGive(outputTaskHandle);
+  return true;
+}
+
+void outputTask(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Apply everything queued so far, then publish once
+    uint32_t mask = lightStateMask.load(std::memory_order_relaxed);
+    uint32_t changed = 0;
+    uint32_t toSave = 0;
+    uint32_t oldestUs = 0;
+    int commands = 0;
+    LightCommand cmd;
+    TRACE_BEGIN("toggleLight");
+    while (lightCommands.pop(cmd)) {
+      if (!changed) oldestUs = cmd.startUs;  // FIFO, so the first is the oldest
+      uint32_t bit = 1u << cmd.light;
+      mask = cmd.state ? (mask | bit) : (mask & ~bit);
+      changed |= bit;
+      if (cmd.save) toSave |= bit;
+      ++commands;
+    }
+    if (commands == 1) {
+      BoardLights::set(cmd.light, cmd.state);  // The usual case: one store
+    } else {
+      BoardLights::write(changed, mask);  // Whole batch in one set + one clear
+    }
+    TRACE_END("toggleLight");
+    if (!changed) continue;
+    recordCommandLatency(oldestUs);
+    lightStateMask.store(mask, std::memory_order_release);
+    saveRtcSnapshot(mask);
+
+    // Slow work after the outputs are already switched
+    if (toSave) {
+      TRACE_SCOPE("nvs.write");
+      lightPrefs.begin("light", false);
+      for (int i = 0; i < MAX_LIGHTS; ++i) {
+        if (!(toSave & (1u << i))) continue;
+        String key = "state" + String(i);
+        lightPrefs.putBool(key.c_str(), (mask >> i) & 1);
+      }
+      lightPrefs.end();
+    }
+    TRACE_BEGIN("log.queue");
+    for (int i = 0; i < MAX_LIGHTS; ++i) {
+      if (!(changed & (1u << i))) continue;
+      LOG_I("Light %d (%s): %s", i, lightNames[i].c_str(), ((mask >> i) & 1) ? "ON" : "OFF");
+    }
+    TRACE_END("log.queue");
+  }
+}
+
+void startOutputTask() {
+  xTaskCreatePinnedToCore(outputTask, "outputs", OUTPUT_TASK_STACK, NULL,
+                          OUTPUT_TASK_PRIORITY, &outputTaskHandle, OUTPUT_TASK_CORE);
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef POWER_HELPER_H
+#define POWER_HELPER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <Preferences.h>
+#include <esp_pm.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "log_helper.h"
+
+// Idle power management. The installation sets a latency budget (the
+// longest a light command may wait for the board to wake) and the
+// strongest mode that fits is used:
+//
+//   budget < 20 ms    performance  radio always on, CPU at full clock
+//   budget < 120 ms   balanced     radio always on, DFS down to 80 MHz
+//   budget < 350 ms   modem        DTIM modem sleep, DFS, auto light sleep
+//   otherwise         maxModem     max modem sleep, DFS, auto light sleep
+//
+// Modem sleep only wakes the radio for DTIM beacons (~102 ms apart), so it
+// is only picked when the budget covers one (modem) or three (maxModem)
+// beacon intervals. esp_timer keeps counting through light sleep, so
+// millis() timers stay correct, and the light pins keep their level.
+// With ENABLE_TRACE the CPU clock is locked at its maximum (no DFS, no
+// light sleep) because /trace converts cycles to µs at a fixed clock.
+
+enum PowerMode : uint8_t {
+  POWER_PERFORMANCE = 0,
+  POWER_BALANCED,
+  POWER_MODEM,
+  POWER_MAX_MODEM,
+  POWER_MODE_COUNT
+};
+
+const char* powerModeNames[POWER_MODE_COUNT] = {"performance", "balanced", "modem", "maxModem"};
+
+uint32_t latencyBudgetMs = POWER_DEFAULT_BUDGET_MS;
+
+// Mode state below is shared by loop() and the AsyncTCP task (POST and
+// GET /power). Hold powerLock to read or change it.
+SemaphoreHandle_t powerLock = nullptr;  // created by loadPowerConfig()
+PowerMode powerMode = POWER_PERFORMANCE;
+bool dfsSupported = false;      // esp_pm_configure() accepted (CONFIG_PM_ENABLE)
+bool lightSleepActive = false;  // ...with auto light sleep (tickless idle)
+int64_t powerModeSinceUs = 0;
+int64_t timeConfiguredUs[POWER_MODE_COUNT] = {0};  // wall time each mode was set
+
+#if ENABLE_TRACE
+esp_pm_lock_handle_t traceClockLock = nullptr;
+#endif
+
+// Command latency: request headers parsed to outputs switched. This is
+// the on-device part only, radio and light-sleep wake-up are not included.
+// Written by the output task, read with commandLatencySnapshot().
+struct CommandLatency {
+  uint32_t lastUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint32_t samples;
+};
+CommandLatency commandLatency = {0, 0, 0, 0};
+portMUX_TYPE commandLatencyLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Time actually spent in light sleep and awake since boot
+struct PowerResidency {
+  bool measured;
+  int64_t lightSleepUs;
+  int64_t awakeUs;
+};
+
+// Arrival time of recent requests, stamped by RequestTimer. Written and
+// read only on the AsyncTCP task.
+struct RequestStamp {
+  AsyncWebServerRequest *request;
+  uint32_t us;
+};
+const int requestStampCount = 8;
+RequestStamp requestStamps[requestStampCount];
+uint8_t nextRequestStamp = 0;
+
+PowerMode powerModeForBudget(uint32_t budgetMs) {
+  if (budgetMs < 20) return POWER_PERFORMANCE;
+  if (budgetMs < 120) return POWER_BALANCED;
+  if (budgetMs < 350) return POWER_MODEM;
+  return POWER_MAX_MODEM;
+}
+
+// Call loadPowerConfig() first. Returns the mode now in use.
+PowerMode applyPowerMode() {
+  xSemaphoreTake(powerLock, portMAX_DELAY);
+  PowerMode mode = powerModeForBudget(latencyBudgetMs);
+  bool sleep = mode >= POWER_MODEM;
+
+  // DFS + automatic light sleep (needs CONFIG_PM_ENABLE in the core)
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = 240;
+  pm.min_freq_mhz = mode == POWER_PERFORMANCE ? 240 : 80;
+  pm.light_sleep_enable = sleep;
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK && sleep) {
+    // PM without tickless idle rejects light sleep, keep DFS at least
+    pm.light_sleep_enable = false;
+    err = esp_pm_configure(&pm);
+  }
+  dfsSupported = err == ESP_OK;
+  lightSleepActive = dfsSupported && pm.light_sleep_enable;
+  if (!dfsSupported) {
+    // No PM in this core build: fixed clock instead of DFS, no light sleep
+#if ENABLE_TRACE
+    setCpuFrequencyMhz(240);
+#else
+    setCpuFrequencyMhz(mode == POWER_PERFORMANCE ? 240 : mode == POWER_BALANCED ? 160 : 80);
+#endif
+  }
+
+  // Keep the light outputs driven while the chip sleeps
+  for (int i = 0; i < MAX_LIGHTS; ++i) {
+    gpio_sleep_sel_dis((gpio_num_t)BoardLights::pins[i]);
+  }
+
+  // Through the core, not esp_wifi_set_ps(): it re-applies this every time
+  // the station starts (/connect, /newWiFiCredentials, reconnects), where it
+  // would otherwise fall back to its default of modem sleep
+  WiFi.setSleep(mode == POWER_MAX_MODEM ? WIFI_PS_MAX_MODEM : sleep ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+
+  int64_t now = esp_timer_get_time();
+  timeConfiguredUs[powerMode] += now - powerModeSinceUs;
+  powerModeSinceUs = now;
+  powerMode = mode;
+  xSemaphoreGive(powerLock);
+
+  LOG_I("Power mode %s (budget %lu ms, dfs %s, light sleep %s)", powerModeNames[mode],
+        (unsigned long)latencyBudgetMs, dfsSupported ? "on" : "off", lightSleepActive ? "on" : "off");
+  return mode;
+}
+
+void loadPowerConfig() {
+  Preferences prefs;
+  prefs.begin("power", true);
+  latencyBudgetMs = prefs.getUInt("budgetMs", POWER_DEFAULT_BUDGET_MS);
+  prefs.end();
+  powerLock = xSemaphoreCreateMutex();
+  powerModeSinceUs = esp_timer_get_time();
+#if ENABLE_TRACE
+  // Held for good: keeps DFS and light sleep off whatever mode is applied
+  if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "trace", &traceClockLock) == ESP_OK) {
+    esp_pm_lock_acquire(traceClockLock);
+  }
+#endif
+}
+
+void savePowerConfig() {
+  Preferences prefs;
+  prefs.begin("power", false);
+  prefs.putUInt("budgetMs", latencyBudgetMs);
+  prefs.end();
+}
+
+// Sees every request before the real handlers, only to note when it arrived
+class RequestTimer : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    requestStamps[nextRequestStamp] = {request, (uint32_t)micros()};
+    nextRequestStamp = (nextRequestStamp + 1) % requestStampCount;
+    return false;
+  }
+};
+
+RequestTimer requestTimer;
+
+// Newest stamp first: a freed request's address can come back for a later
+// one. The stamp is cleared once used.
+uint32_t requestStartUs(AsyncWebServerRequest *request) {
+  for (int n = 1; n <= requestStampCount; ++n) {
+    RequestStamp &stamp = requestStamps[(nextRequestStamp + requestStampCount - n) % requestStampCount];
+    if (stamp.request == request) {
+      stamp.request = nullptr;
+      return stamp.us;
+    }
+  }
+  return micros();  // stamp already overwritten
+}
+
+void recordCommandLatency(uint32_t startUs) {
+  uint32_t us = micros() - startUs;
+  portENTER_CRITICAL(&commandLatencyLock);
+  commandLatency.lastUs = us;
+  if (us > commandLatency.maxUs) commandLatency.maxUs = us;
+  commandLatency.totalUs += us;
+  ++commandLatency.samples;
+  portEXIT_CRITICAL(&commandLatencyLock);
+}
+
+CommandLatency commandLatencySnapshot() {
+  portENTER_CRITICAL(&commandLatencyLock);
+  CommandLatency copy = commandLatency;
+  portEXIT_CRITICAL(&commandLatencyLock);
+  return copy;
+}
+
+// Read the "Mode stats:" table printed by esp_pm_dump_locks(), e.g.
+//   SLEEP     40 M        10230417    85%
+//   CPU_MAX   240M        1420188     11%
+// SLEEP is light sleep, every other mode is awake at some clock.
+PowerResidency parsePmModeStats(const char *text) {
+  PowerResidency r = {false, 0, 0};
+  const char *line = strstr(text, "Mode stats:");
+  while (line && (line = strchr(line, '\n'))) {
+    ++line;
+    char mode[16];
+    int mhz;
+    long long us;
+    if (sscanf(line, "%15s %d M %lld", mode, &mhz, &us) != 3) continue;
+    r.measured = true;
+    if (strcmp(mode, "SLEEP") == 0) r.lightSleepUs += us;
+    else r.awakeUs += us;
+  }
+  return r;
+}
+
+// Measured residency from the esp_pm profiler. It only exists when the core
+// is built with CONFIG_PM_PROFILING, which the stock Arduino core is not;
+// then `measured` is false. Modem sleep has no counter at all.
+PowerResidency powerResidency() {
+#ifdef CONFIG_PM_PROFILING
+  char *text = nullptr;
+  size_t len = 0;
+  FILE *f = open_memstream(&text, &len);
+  if (f) {
+    esp_pm_dump_locks(f);
+    fclose(f);
+    PowerResidency r = parsePmModeStats(text);
+    free(text);
+    return r;
+  }
+#endif
+  PowerResidency r = {false, 0, 0};
+  return r;
+}
+
+#endif
@@ -6,6 +6,9 @@
 #include "storage_helper.h"
 #include "wifi_helper.h"
 #include "config.h"
+#include "output_task.h"
+#include "trace.h"
+#include "body_helper.h"
 
 extern const char* device_name;
 extern int NUM_LIGHTS;
@@ -14,31 +17,7 @@ unsigned long lastToggleTime = 0;
 const unsigned long debounceDelay = 500;
 
 bool lightState = false;
-bool lightStates[MAX_LIGHTS] = {false};
-String lightNames[MAX_LIGHTS] = {"Light 1", "Light 2", "Light 3", "Light 4"};
-int lightPins[MAX_LIGHTS] = {2, 4, 5, 18};
-
-void saveLightState(int i, bool state) {
-  preferences.begin("light", false);
-  String key = "state" + String(i);
-  preferences.putBool(key.c_str(), state);
-  preferences.end();
-}
-
-bool loadLightState(int i) {
-  preferences.begin("light", true);
-  String key = "state" + String(i);
-  bool state = preferences.getBool(key.c_str(), false);
-  preferences.end();
-  return state;
-}
-
-void toggleLight(int i, bool state, bool save = true) {
-  lightStates[i] = state;
-  digitalWrite(lightPins[i], state ? HIGH : LOW);
-  if (save) saveLightState(i, state);
-  Serial.printf("Light %d (%s): %s\n", i, lightNames[i].c_str(), state ? "ON" : "OFF");
-}
+String lightNames[MAX_LIGHTS];  // Filled from Preferences in setup()
 
 void setupPythonRoutes(AsyncWebServer& server) {
   // /id
@@ -65,7 +44,7 @@ void setupPythonRoutes(AsyncWebServer& server) {
     for (int i = 0; i < NUM_LIGHTS; ++i) {
       JsonObject obj = states.createNestedObject();
       obj["name"] = lightNames[i];
-      obj["state"] = lightStates[i] ? "on" : "off";
+      obj["state"] = isLightOn(i) ? "on" : "off";
     }
 
     String json;
@@ -73,11 +52,90 @@ void setupPythonRoutes(AsyncWebServer& server) {
     request->send(200, "application/json", json);
   });
 
+  // /boot - how the outputs came back after the last reset
+  server.on("/boot", HTTP_GET, [](AsyncWebServerRequest *request) {
+    static const char* reasons[] = {"unknown", "restart", "saveConfig"};
+    DynamicJsonDocument doc(256);
+    doc["path"] = bootPath;
+    doc["outputStableUs"] = bootOutputStableUs;
+    doc["bootReason"] = lastBootReason <= BOOT_SAVE_CONFIG ? reasons[lastBootReason] : "unknown";
+    doc["resetReason"] = (int)esp_reset_reason();
+    doc["configVersion"] = configVersion;
+
+    String json;
+    serializeJson(doc, json);
+    request->send(200, "application/json", json);
+  });
+
+  // /power - current power mode, latency and residency
+  server.on("/power", HTTP_GET, [](AsyncWebServerRequest *request) {
+    DynamicJsonDocument doc(640);
+    xSemaphoreTake(powerLock, portMAX_DELAY);
+    doc["mode"] = powerModeNames[powerMode];
+    doc["latencyBudgetMs"] = latencyBudgetMs;
+    doc["dfs"] = dfsSupported;
+    doc["lightSleep"] = lightSleepActive;
+    JsonObject modes = doc.createNestedObject("timeConfiguredMs");
+    int64_t now = esp_timer_get_time();
+    for (int m = 0; m < POWER_MODE_COUNT; ++m) {
+      int64_t us = timeConfiguredUs[m] + (m == powerMode ? now - powerModeSinceUs : 0);
+      modes[powerModeNames[m]] = (uint32_t)(us / 1000);
+    }
+    xSemaphoreGive(powerLock);
+    doc["cpuMhz"] = getCpuFrequencyMhz();
+
+    PowerResidency residency = powerResidency();
+    if (residency.measured) {
+      JsonObject res = doc.createNestedObject("residencyMs");
+      res["lightSleep"] = (uint32_t)(residency.lightSleepUs / 1000);
+      res["awake"] = (uint32_t)(residency.awakeUs / 1000);
+    } else {
+      doc["residencyMs"] = nullptr;  // core built without CONFIG_PM_PROFILING
+    }
+
+    CommandLatency stats = commandLatencySnapshot();
+    JsonObject latency = doc.createNestedObject("commandLatencyUs");
+    latency["last"] = stats.lastUs;
+    latency["max"] = stats.maxUs;
+    latency["avg"] = stats.samples ? (uint32_t)(stats.totalUs / stats.samples) : 0;
+    latency["samples"] = stats.samples;
+    doc["wakeLatencyUs"] = nullptr;  // not measurable on the device, see readme
+
+    String json;
+    serializeJson(doc, json);
+    request->send(200, "application/json", json);
+  });
+
+  // /power - set the latency budget, e.g. {"latencyBudgetMs": 200}
+  server.on("/power", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
+  assembleBody([](AsyncWebServerRequest* request, uint8_t* data, size_t len) {
+    DynamicJsonDocument doc(128);
+    if (deserializeJson(doc, data, len)) {
+      request->send(400, "application/json", "{\"error\": \"Invalid JSON\"}");
+      return;
+    }
+
+    int budget = doc["latencyBudgetMs"] | -1;
+    if (budget < 1 || budget > 10000) {
+      request->send(400, "application/json", "{\"error\": \"latencyBudgetMs must be 1-10000\"}");
+      return;
+    }
+
+    latencyBudgetMs = budget;
+    savePowerConfig();
+    PowerMode mode = applyPowerMode();
+
+    String response = "{\"mode\":\"" + String(powerModeNames[mode]) + "\"," +
+                      "\"latencyBudgetMs\":" + String(latencyBudgetMs) + "}";
+    request->send(200, "application/json", response);
+  }));
+
   // /lightName/toggle
   for (int i = 0; i < NUM_LIGHTS; ++i) {
     String path = "/" + lightNames[i] + "/toggle";
     server.on(path.c_str(), HTTP_POST, [i](AsyncWebServerRequest* request) {}, NULL,
-    [i](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t, size_t) {
+    assembleBody([i](AsyncWebServerRequest* request, uint8_t* data, size_t len) {
+      TRACE_SCOPE("http.toggle");
       if (millis() - lastToggleTime < debounceDelay) {
         request->send(429, "application/json", "{\"error\": \"Too many requests\"}");
         return;
@@ -85,28 +143,33 @@ void setupPythonRoutes(AsyncWebServer& server) {
       lastToggleTime = millis();
 
       DynamicJsonDocument doc(256);
-      if (deserializeJson(doc, data, len)) {
+      TRACE_BEGIN("deserializeJson");
+      DeserializationError err = deserializeJson(doc, data, len);
+      TRACE_END("deserializeJson");
+      if (err) {
         request->send(400, "application/json", "{\"error\": \"Invalid JSON\"}");
         return;
       }
 
       String action = doc["action"];
-      if (action == "on") {
-        toggleLight(i, true);
-      } else if (action == "off") {
-        toggleLight(i, false);
-      } else {
+      if (action != "on" && action != "off") {
         request->send(400, "application/json", "{\"error\": \"Unknown action\"}");
         return;
       }
+      if (!requestLight(i, action == "on", true, requestStartUs(request))) {
+        request->send(503, "application/json", "{\"error\": \"Output queue full\"}");
+        return;
+      }
 
+      TRACE_BEGIN("response.send");
       request->send(200, "application/json", "{\"status\": \"success\"}");
-    });
+      TRACE_END("response.send");
+    }));
   }
 
   // /newWiFiCredentials
   server.on("/newWiFiCredentials", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
-    [](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t, size_t) {
+    assembleBody([](AsyncWebServerRequest* request, uint8_t* data, size_t len) {
       DynamicJsonDocument doc(256);
       DeserializationError err = deserializeJson(doc, data, len);
       if (err) {
@@ -116,29 +179,29 @@ void setupPythonRoutes(AsyncWebServer& server) {
 
       String new_ssid = doc["ssid"];
       String new_pass = doc["password"];
-      Serial.println("Trying new credentials: " + new_ssid);
+      LOG_I("Trying new credentials: %s", new_ssid.c_str());
 
       WiFi.begin(new_ssid.c_str(), new_pass.c_str());
       unsigned long startAttempt = millis();
       while (WiFi.status() != WL_CONNECTED && millis() - startAttempt < 10000) {
         delay(500);
-        Serial.print(".");
       }
 
       if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\nConnected to new WiFi!");
+        LOG_I("Connected to new WiFi!");
         saveCredentials(new_ssid, new_pass);
         request->send(200, "application/json", "{\"status\": \"connected\"}");
       } else {
-        Serial.println("\nFailed to connect. Staying on old WiFi.");
+        LOG_W("Failed to connect. Staying on old WiFi.");
         request->send(500, "application/json", "{\"error\": \"Failed to connect\"}");
         setupAP(); // fallback if needed
       }
-    });
+    }));
 
   // /testToggle (temporary toggle - no save)
   server.on("/testToggle", HTTP_POST, [](AsyncWebServerRequest* request) {}, NULL,
-  [](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t, size_t) {
+  assembleBody([](AsyncWebServerRequest* request, uint8_t* data, size_t len) {
+    TRACE_SCOPE("http.testToggle");
     unsigned long now = millis();
     if (now - lastToggleTime < debounceDelay) {
       request->send(429, "application/json", "{\"error\": \"Too many requests\"}");
@@ -147,7 +210,9 @@ void setupPythonRoutes(AsyncWebServer& server) {
     lastToggleTime = now;
 
     DynamicJsonDocument doc(256);
+    TRACE_BEGIN("deserializeJson");
     DeserializationError err = deserializeJson(doc, data, len);
+    TRACE_END("deserializeJson");
     if (err) {
       request->send(400, "application/json", "{\"error\": \"Invalid JSON\"}");
       return;
@@ -161,21 +226,25 @@ void setupPythonRoutes(AsyncWebServer& server) {
       return;
     }
 
-    if (action == "on") {
-      toggleLight(lightIndex, true, false);
-    } else if (action == "off") {
-      toggleLight(lightIndex, false, false);
-    } else {
+    if (action != "on" && action != "off") {
       request->send(400, "application/json", "{\"error\": \"Unknown action\"}");
       return;
     }
+    bool state = action == "on";
+    if (!requestLight(lightIndex, state, false, requestStartUs(request))) {
+      request->send(503, "application/json", "{\"error\": \"Output queue full\"}");
+      return;
+    }
 
+    // Report the requested state; the output task applies it right after
     String response = "{\"light\":" + String(lightIndex) +
                       ",\"name\":\"" + lightNames[lightIndex] + "\"," +
-                      "\"state\":" + String(lightStates[lightIndex] ? 1 : 0) + "}";
+                      "\"state\":" + String(state ? 1 : 0) + "}";
 
+    TRACE_BEGIN("response.send");
     request->send(200, "application/json", response);
-  });
+    TRACE_END("response.send");
+  }));
 
 
   // /test page
@@ -297,7 +366,7 @@ void setupPythonRoutes(AsyncWebServer& server) {
     request->send(200, "text/plain", "Restarting...");
     request->redirect("/");
     delay(500);
-    ESP.restart();
+    warmRestart(BOOT_RESTART_ROUTE);
   });
 }
 
@@ -0,0 +1,85 @@
+#ifndef RTC_STATE_H
+#define RTC_STATE_H
+
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include "config.h"
+
+extern int NUM_LIGHTS;
+
+// Why we restarted ourselves, kept across the reset
+enum BootReason : uint32_t {
+  BOOT_UNKNOWN = 0,
+  BOOT_RESTART_ROUTE = 1,   // /restart
+  BOOT_SAVE_CONFIG = 2,     // /saveConfig
+};
+
+// Lives in RTC slow memory: survives ESP.restart() and panics, lost on power loss
+struct RtcSnapshot {
+  uint32_t magic;
+  uint32_t lightMask;
+  uint32_t numLights;
+  uint32_t configVersion;
+  uint32_t bootReason;
+  uint32_t checksum;
+};
+
+#define RTC_SNAPSHOT_MAGIC 0x4C474854  // "LGHT"
+
+RTC_NOINIT_ATTR RtcSnapshot rtcSnapshot;
+
+uint32_t configVersion = 0;        // Bumped in NVS on every /saveConfig
+uint32_t lastBootReason = BOOT_UNKNOWN;
+const char* bootPath = "nvs";      // Where the outputs were restored from
+// App start to outputs driven (esp_timer). The ROM and second-stage
+// bootloader run before esp_timer starts and are not included.
+int64_t bootOutputStableUs = 0;
+
+uint32_t rtcChecksum(const RtcSnapshot &s) {
+  // FNV-1a over every field except the checksum itself
+  const uint8_t *p = (const uint8_t *)&s;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < offsetof(RtcSnapshot, checksum); ++i) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return h;
+}
+
+bool rtcSnapshotValid() {
+  // RTC memory is garbage after power-up or brownout
+  esp_reset_reason_t reason = esp_reset_reason();
+  if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT || reason == ESP_RST_UNKNOWN) return false;
+  return rtcSnapshot.magic == RTC_SNAPSHOT_MAGIC &&
+         rtcSnapshot.numLights <= MAX_LIGHTS &&
+         rtcSnapshot.checksum == rtcChecksum(rtcSnapshot);
+}
+
+void saveRtcSnapshot(uint32_t lightMask) {
+  rtcSnapshot.magic = RTC_SNAPSHOT_MAGIC;
+  rtcSnapshot.lightMask = lightMask;
+  rtcSnapshot.numLights = NUM_LIGHTS;
+  rtcSnapshot.configVersion = configVersion;
+  rtcSnapshot.checksum = rtcChecksum(rtcSnapshot);
+}
+
+// Restart while keeping the outputs where they are. Pad hold keeps the
+// levels latched through the reset until setup() releases them.
+void warmRestart(BootReason reason) {
+  rtcSnapshot.bootReason = reason;
+  rtcSnapshot.checksum = rtcChecksum(rtcSnapshot);
+  for (int i = 0; i < NUM_LIGHTS; ++i) {
+    gpio_hold_en((gpio_num_t)BoardLights::pins[i]);
+  }
+  ESP.restart();
+}
+
+void releaseOutputHold() {
+  for (int i = 0; i < MAX_LIGHTS; ++i) {
+    gpio_hold_dis((gpio_num_t)BoardLights::pins[i]);
+  }
+}
+
+#endif
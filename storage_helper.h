@@ -2,6 +2,7 @@
 #define STORAGE_HELPER_H
 
 #include <Preferences.h>
+#include "log_helper.h"
 extern String lightNames[MAX_LIGHTS];
 
 Preferences preferences;
@@ -11,7 +12,7 @@ void saveCredentials(const String &ssid, const String &password) {
   preferences.putString("ssid", ssid);
   preferences.putString("pass", password);
   preferences.end();
-  Serial.println("Credentials saved.");
+  LOG_I("Credentials saved.");
 }
 
 bool loadCredentials(String &ssid, String &password) {
@@ -0,0 +1,46 @@
+// Benchmark for body_pool.h: assembly throughput for bodies split into
+// chunks of different sizes, against the single-chunk pass-through.
+//   body_pool_bench [body size]
+
+#include "body_pool.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef BodyPool<4, 2048> Pool;
+
+static volatile uint8_t sink;
+
+static void bench(Pool &pool, const std::vector<uint8_t> &body, size_t chunk) {
+  const int rounds = 200000;
+  int owner;
+  Clock::time_point start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    const uint8_t *out = nullptr;
+    for (size_t pos = 0; pos < body.size(); pos += chunk) {
+      size_t len = body.size() - pos < chunk ? body.size() - pos : chunk;
+      pool.feed(&owner, body.data() + pos, len, pos, body.size(), &out);
+    }
+    sink = out[body.size() - 1];
+    pool.release(&owner);
+  }
+  double s = std::chrono::duration<double>(Clock::now() - start).count();
+  printf("%4zu-byte body in %4zu-byte chunks: %7.1f ns/body, %7.1f MB/s\n",
+         body.size(), chunk, s * 1e9 / rounds, body.size() * (double)rounds / s / 1e6);
+}
+
+int main(int argc, char **argv) {
+  size_t size = argc > 1 ? (size_t)atoi(argv[1]) : 1460;
+  if (size < 1 || size > 2048) size = 1460;
+  std::vector<uint8_t> body(size, 'x');
+  static Pool pool;
+  bench(pool, body, size);  // single chunk, no copy
+  const size_t chunks[] = {536, 128, 16};
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+    if (chunks[i] < size) bench(pool, body, chunks[i]);
+  }
+  return 0;
+}
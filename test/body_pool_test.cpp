@@ -0,0 +1,144 @@
+// Fuzz test for body_pool.h: replays randomly fragmented bodies, with
+// several requests interleaved, plus the out-of-order, oversize and
+// pool-exhaustion cases.
+
+#include "body_pool.h"
+#include "check.h"
+
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+const size_t kSlots = 4;
+const size_t kMax = 2048;
+typedef BodyPool<kSlots, kMax> Pool;
+
+struct Upload {
+  std::vector<uint8_t> body;
+  std::vector<size_t> cuts;  // chunk boundaries, ending with body.size()
+  size_t nextChunk;
+};
+
+static Upload makeUpload(std::mt19937 &rng, size_t total) {
+  Upload u;
+  u.body.resize(total);
+  for (size_t i = 0; i < total; ++i) u.body[i] = (uint8_t)rng();
+  size_t pos = 0;
+  do {
+    size_t left = total - pos;
+    size_t len = left == 0 ? 0 : 1 + rng() % (left < 700 ? left : 700);
+    pos += len;
+    u.cuts.push_back(pos);
+  } while (pos < total);
+  u.nextChunk = 0;
+  return u;
+}
+
+// Feed the next chunk of `u`. Returns the pool result.
+static BodyResult feedNext(Pool &pool, Upload &u, const uint8_t **out) {
+  size_t start = u.nextChunk == 0 ? 0 : u.cuts[u.nextChunk - 1];
+  size_t end = u.cuts[u.nextChunk++];
+  return pool.feed(&u, u.body.data() + start, end - start, start, u.body.size(), out);
+}
+
+// Random splits, up to kSlots uploads interleaved in random order
+static void fuzzInterleaved(std::mt19937 &rng, int rounds) {
+  static Pool pool;
+  for (int r = 0; r < rounds; ++r) {
+    std::vector<Upload> uploads;
+    size_t count = 1 + rng() % kSlots;
+    for (size_t i = 0; i < count; ++i) uploads.push_back(makeUpload(rng, rng() % (kMax + 1)));
+
+    size_t done = 0;
+    while (done < count) {
+      Upload &u = uploads[rng() % count];
+      if (u.nextChunk == u.cuts.size()) continue;
+      const uint8_t *body = nullptr;
+      BodyResult res = feedNext(pool, u, &body);
+      if (u.nextChunk < u.cuts.size()) {
+        CHECK(res == BODY_PENDING);
+      } else {
+        CHECK(res == BODY_COMPLETE);
+        CHECK(u.body.empty() || memcmp(body, u.body.data(), u.body.size()) == 0);
+        pool.release(&u);
+        ++done;
+      }
+    }
+    CHECK(pool.inUse() == 0);
+  }
+}
+
+static void testOversize() {
+  static Pool pool;
+  std::vector<uint8_t> data(100);
+  const uint8_t *body;
+  int owner;
+  CHECK(pool.feed(&owner, data.data(), 100, 0, kMax + 1, &body) == BODY_TOO_LARGE);
+  CHECK(pool.feed(&owner, data.data(), 100, 100, kMax + 1, &body) == BODY_IGNORED);
+  CHECK(pool.inUse() == 0);
+
+  // Exactly at the cap is fine
+  std::vector<uint8_t> full(kMax, 7);
+  CHECK(pool.feed(&owner, full.data(), 1000, 0, kMax, &body) == BODY_PENDING);
+  CHECK(pool.feed(&owner, full.data() + 1000, kMax - 1000, 1000, kMax, &body) == BODY_COMPLETE);
+  pool.release(&owner);
+  CHECK(pool.inUse() == 0);
+}
+
+static void testOutOfOrder(std::mt19937 &rng, int rounds) {
+  static Pool pool;
+  for (int r = 0; r < rounds; ++r) {
+    Upload u = makeUpload(rng, 100 + rng() % (kMax - 100));
+    if (u.cuts.size() < 3) continue;
+    const uint8_t *body;
+    CHECK(feedNext(pool, u, &body) == BODY_PENDING);
+    u.nextChunk++;  // drop a chunk
+    CHECK(feedNext(pool, u, &body) == BODY_MALFORMED);
+    CHECK(pool.inUse() == 0);
+    while (u.nextChunk < u.cuts.size()) CHECK(feedNext(pool, u, &body) == BODY_IGNORED);
+  }
+
+  // Chunk running past total
+  int owner;
+  uint8_t data[64] = {0};
+  const uint8_t *body;
+  CHECK(pool.feed(&owner, data, 32, 0, 48, &body) == BODY_PENDING);
+  CHECK(pool.feed(&owner, data, 32, 32, 48, &body) == BODY_MALFORMED);
+  CHECK(pool.inUse() == 0);
+}
+
+static void testExhaustion() {
+  static Pool pool;
+  int owners[kSlots + 1];
+  uint8_t data[16] = {0};
+  const uint8_t *body;
+  for (size_t i = 0; i < kSlots; ++i) CHECK(pool.feed(&owners[i], data, 8, 0, 16, &body) == BODY_PENDING);
+  CHECK(pool.feed(&owners[kSlots], data, 8, 0, 16, &body) == BODY_BUSY);
+  CHECK(pool.feed(&owners[kSlots], data + 8, 8, 8, 16, &body) == BODY_IGNORED);
+
+  // Single-chunk bodies never need a buffer
+  CHECK(pool.feed(&owners[kSlots], data, 16, 0, 16, &body) == BODY_COMPLETE);
+  CHECK(body == data);
+
+  // A disconnect frees the buffer for the next request
+  pool.release(&owners[0]);
+  pool.release(&owners[0]);
+  CHECK(pool.inUse() == kSlots - 1);
+  CHECK(pool.feed(&owners[kSlots], data, 8, 0, 16, &body) == BODY_PENDING);
+  for (size_t i = 1; i <= kSlots; ++i) {
+    CHECK(pool.feed(&owners[i], data + 8, 8, 8, 16, &body) == BODY_COMPLETE);
+    pool.release(&owners[i]);
+  }
+  CHECK(pool.inUse() == 0);
+}
+
+int main(int argc, char **argv) {
+  std::mt19937 rng(argc > 1 ? atoi(argv[1]) : 12345);
+  testOversize();
+  testExhaustion();
+  testOutOfOrder(rng, 2000);
+  fuzzInterleaved(rng, 20000);
+  printf("body_pool_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,72 @@
+// Throughput benchmark for command_queue.h.
+//   command_queue_bench [producers] [items per producer]
+
+#include "command_queue.h"
+#include "light_command.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Push then pop on one thread: the uncontended cost of a round trip
+static void benchUncontended(uint32_t items) {
+  CommandQueue<LightCommand, 16> q;
+  LightCommand cmd = {1, true, false, 0};
+  Clock::time_point start = Clock::now();
+  for (uint32_t i = 0; i < items; ++i) {
+    cmd.startUs = i;
+    q.push(cmd);
+    q.pop(cmd);
+  }
+  double s = secondsSince(start);
+  printf("uncontended push+pop: %.1f ns/op\n", s * 1e9 / items);
+}
+
+static void benchContended(int producers, uint32_t perProducer) {
+  CommandQueue<LightCommand, 16> q;
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&q, p, perProducer]() {
+      LightCommand cmd = {(uint8_t)p, true, false, 0};
+      for (uint32_t i = 0; i < perProducer;) {
+        if (q.push(cmd)) {
+          ++i;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint64_t expected = (uint64_t)producers * perProducer;
+  uint64_t received = 0;
+  LightCommand cmd;
+  while (received < expected) {
+    if (q.pop(cmd)) {
+      ++received;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (auto &t : threads) t.join();
+  double s = secondsSince(start);
+  printf("%d producers: %.2f M items/s (%.1f ns/item)\n", producers, expected / s / 1e6, s * 1e9 / expected);
+}
+
+int main(int argc, char **argv) {
+  int producers = argc > 1 ? atoi(argv[1]) : 4;
+  uint32_t perProducer = argc > 2 ? (uint32_t)atoi(argv[2]) : 250000;
+  benchUncontended(10000000);
+  benchContended(1, perProducer);
+  if (producers > 1) benchContended(producers, perProducer);
+  return 0;
+}
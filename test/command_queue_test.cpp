@@ -0,0 +1,78 @@
+// Stress test for command_queue.h: several producers, one consumer.
+// Every item must arrive exactly once and in order per producer.
+
+#include "command_queue.h"
+#include "check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+struct Item {
+  uint32_t producer;
+  uint32_t seq;
+};
+
+static void testSingleThreaded() {
+  CommandQueue<int, 4> q;
+  int v;
+  CHECK(!q.pop(v));
+  for (int i = 0; i < 4; ++i) CHECK(q.push(i));
+  CHECK(!q.push(99));  // full
+  for (int i = 0; i < 4; ++i) {
+    CHECK(q.pop(v));
+    CHECK(v == i);
+  }
+  CHECK(!q.pop(v));
+
+  // Wrap around many times
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(q.push(i));
+    CHECK(q.pop(v));
+    CHECK(v == i);
+  }
+}
+
+static void testStress(int producers, uint32_t perProducer) {
+  CommandQueue<Item, 16> q;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&q, p, perProducer]() {
+      for (uint32_t i = 0; i < perProducer;) {
+        if (q.push({(uint32_t)p, i})) {
+          ++i;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<uint32_t> next(producers, 0);
+  uint64_t received = 0;
+  uint64_t expected = (uint64_t)producers * perProducer;
+  Item item;
+  while (received < expected) {
+    if (!q.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    CHECK(item.producer < (uint32_t)producers);
+    CHECK(item.seq == next[item.producer]);
+    ++next[item.producer];
+    ++received;
+  }
+  for (auto &t : threads) t.join();
+  CHECK(!q.pop(item));
+  for (int p = 0; p < producers; ++p) CHECK(next[p] == perProducer);
+}
+
+int main() {
+  testSingleThreaded();
+  testStress(1, 200000);
+  testStress(4, 100000);
+  testStress(8, 25000);
+  printf("command_queue_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Benchmark: LightBank::set() and write() against the old runtime path, a
+// lightPins[] lookup plus one digitalWrite() per changed light.
+// digitalWrite() is modelled on the ESP32 core: a non-inlined call that
+// checks the pin and stores to the set or clear register.
+
+#include "light_bank.h"
+
+#include <chrono>
+#include <stdio.h>
+
+volatile uint32_t hostGpioRegs[HOST_GPIO_REGS];
+
+typedef LightBank<2, 4, 5, 18> Board;
+typedef std::chrono::steady_clock Clock;
+
+int lightPins[4] = {2, 4, 5, 18};
+
+__attribute__((noinline)) void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin > 39) return;
+  if (pin < 32) {
+    if (val) hostGpioRegs[HOST_GPIO_OUT_SET] = 1u << pin;
+    else hostGpioRegs[HOST_GPIO_OUT_CLEAR] = 1u << pin;
+  } else {
+    if (val) hostGpioRegs[HOST_GPIO_OUT1_SET] = 1u << (pin - 32);
+    else hostGpioRegs[HOST_GPIO_OUT1_CLEAR] = 1u << (pin - 32);
+  }
+}
+
+static void runtimeWrite(uint32_t channels, uint32_t states) {
+  for (int i = 0; i < 4; ++i) {
+    if (channels & (1u << i)) digitalWrite(lightPins[i], (states >> i) & 1);
+  }
+}
+
+// Single toggle of a runtime-chosen light, as in toggleLight()
+static void bankSet(uint32_t, uint32_t update) {
+  Board::set((update >> 4) & 3, update & 1);
+}
+
+static void runtimeSet(uint32_t, uint32_t update) {
+  digitalWrite(lightPins[(update >> 4) & 3], update & 1);
+}
+
+// Pseudo-random updates so neither path is constant-folded
+static uint32_t updates[1024];
+
+template <typename Fn>
+static double nsPerUpdate(Fn fn, uint32_t channelMask) {
+  const int rounds = 20000;
+  Clock::time_point start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (int i = 0; i < 1024; ++i) fn(channelMask, updates[i]);
+  }
+  double s = std::chrono::duration<double>(Clock::now() - start).count();
+  return s * 1e9 / (rounds * 1024.0);
+}
+
+int main() {
+  uint32_t x = 12345;
+  for (int i = 0; i < 1024; ++i) {
+    x = x * 1103515245u + 12345u;
+    updates[i] = x >> 16;
+  }
+
+  double bank = nsPerUpdate(bankSet, 0);
+  double runtime = nsPerUpdate(runtimeSet, 0);
+  printf("1 light : LightBank::set   %6.2f ns, lightPins[]+digitalWrite %6.2f ns (%.1fx)\n",
+         bank, runtime, runtime / bank);
+
+  const uint32_t cases[] = {0x1, 0x3, 0xF};
+  const char *names[] = {"1 light ", "2 lights", "4 lights"};
+  for (int c = 0; c < 3; ++c) {
+    bank = nsPerUpdate(Board::write, cases[c]);
+    runtime = nsPerUpdate(runtimeWrite, cases[c]);
+    printf("%s: LightBank::write %6.2f ns, lightPins[]+digitalWrite %6.2f ns (%.1fx)\n",
+           names[c], bank, runtime, runtime / bank);
+  }
+  return 0;
+}
@@ -0,0 +1,9 @@
+// Must NOT compile: built by ctest with -DPINS=<bad pin list>.
+#include "light_bank.h"
+
+volatile uint32_t hostGpioRegs[HOST_GPIO_REGS];
+
+int main() {
+  LightBank<PINS>::write(1, 1);
+  return 0;
+}
@@ -0,0 +1,81 @@
+// Tests for light_bank.h: register masks and the stores set() and write()
+// make.
+// Bad pin lists are covered by the light_bank_rejects_* ctest entries.
+
+#include "light_bank.h"
+#include "check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+volatile uint32_t hostGpioRegs[HOST_GPIO_REGS];
+
+typedef LightBank<2, 4, 5, 18> Board;
+typedef LightBank<2, 33, 4, 32> HighBank;
+
+static_assert(Board::count == 4, "count");
+static_assert(Board::lowMask(0xF) == ((1u << 2) | (1u << 4) | (1u << 5) | (1u << 18)), "all channels");
+static_assert(Board::lowMask(0x5) == ((1u << 2) | (1u << 5)), "channels 0 and 2");
+static_assert(Board::lowMask(0) == 0, "no channels");
+static_assert(Board::highMask(0xF) == 0, "no high pins");
+static_assert(HighBank::lowMask(0xF) == ((1u << 2) | (1u << 4)), "high bank low pins");
+static_assert(HighBank::highMask(0xF) == ((1u << 1) | (1u << 0)), "GPIO 33 and 32");
+static_assert(Board::lowBit[3] == (1u << 18) && Board::highBit[3] == 0, "channel 3 is GPIO 18");
+static_assert(HighBank::lowBit[1] == 0 && HighBank::highBit[1] == (1u << 1), "channel 1 is GPIO 33");
+
+static void clearRegs() {
+  for (int i = 0; i < HOST_GPIO_REGS; ++i) hostGpioRegs[i] = 0xDEADBEEF;
+}
+
+int main() {
+  CHECK(Board::pins[0] == 2 && Board::pins[3] == 18);
+
+  clearRegs();
+  Board::write(0x3, 0x1);  // channel 0 on, channel 1 off
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_SET] == (1u << 2));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_CLEAR] == (1u << 4));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT1_SET] == 0xDEADBEEF);  // no GPIO 32+ in this bank
+  CHECK(hostGpioRegs[HOST_GPIO_OUT1_CLEAR] == 0xDEADBEEF);
+
+  clearRegs();
+  Board::write(0xF, 0xA);  // only changed channels are touched
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_SET] == ((1u << 4) | (1u << 18)));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_CLEAR] == ((1u << 2) | (1u << 5)));
+
+  clearRegs();
+  Board::write(0x4, 0xFFFFFFFF);  // states outside `channels` are ignored
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_SET] == (1u << 5));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_CLEAR] == 0xDEADBEEF);  // nothing to clear, no store
+
+  clearRegs();
+  Board::write(0, 0);
+  for (int i = 0; i < HOST_GPIO_REGS; ++i) CHECK(hostGpioRegs[i] == 0xDEADBEEF);
+
+  clearRegs();
+  HighBank::write(0xF, 0x6);  // GPIO 33 and 4 on, 2 and 32 off
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_SET] == (1u << 4));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_CLEAR] == (1u << 2));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT1_SET] == (1u << 1));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT1_CLEAR] == (1u << 0));
+
+  // set() makes exactly one store
+  clearRegs();
+  Board::set(2, true);
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_SET] == (1u << 5));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_CLEAR] == 0xDEADBEEF);
+
+  clearRegs();
+  Board::set(3, false);
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_CLEAR] == (1u << 18));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_SET] == 0xDEADBEEF);
+
+  clearRegs();
+  HighBank::set(3, true);  // GPIO 32
+  CHECK(hostGpioRegs[HOST_GPIO_OUT1_SET] == (1u << 0));
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_SET] == 0xDEADBEEF);
+  CHECK(hostGpioRegs[HOST_GPIO_OUT_CLEAR] == 0xDEADBEEF);
+  CHECK(hostGpioRegs[HOST_GPIO_OUT1_CLEAR] == 0xDEADBEEF);
+
+  printf("light_bank_test: ok\n");
+  return 0;
+}
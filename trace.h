@@ -0,0 +1,234 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "config.h"
+
+// Hot-path tracing. Enable with ENABLE_TRACE in config.h; when it is off
+// every macro below expands to nothing and no buffers or routes exist.
+//
+//   TRACE_BEGIN("name"); ... TRACE_END("name");
+//   TRACE_SCOPE("name");   // ends at the closing brace
+//
+// Names must be string literals (only the pointer is stored).
+
+#if ENABLE_TRACE
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_timer.h>
+#include <atomic>
+
+struct TraceEvent {
+  const char *name;
+  uint32_t cycles;   // CPU cycle counter at the event
+  uint32_t task;     // task handle, used as the trace tid
+  uint16_t anchor;   // which ring anchor `cycles` is relative to
+  char phase;        // 'B' or 'E'
+};
+
+// Pairs an esp_timer time (shared by both cores) with this core's cycle
+// counter, so events from both rings land on one timeline. A new anchor
+// is taken well before the 32-bit counter wraps.
+struct TraceAnchor {
+  int64_t us;
+  uint32_t cycles;
+};
+
+#define TRACE_ANCHORS 16
+#define TRACE_ANCHOR_CYCLES (1u << 30)  // ~4.5 s at 240 MHz
+
+// One ring per core, only written by that core with interrupts masked,
+// so writers never wait on each other.
+struct TraceRing {
+  TraceEvent events[TRACE_BUFFER_EVENTS];
+  TraceAnchor anchors[TRACE_ANCHORS];
+  uint16_t anchor = 0;
+  bool anchored = false;
+  std::atomic<uint32_t> next{0};
+};
+
+static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0,
+              "TRACE_BUFFER_EVENTS must be a power of two");
+
+TraceRing traceRings[portNUM_PROCESSORS];
+uint32_t traceOverheadCycles = 0;  // measured once in traceBegin()
+
+inline void traceRecord(const char *name, char phase) {
+  // Masking interrupts pins us to this core, so the core id and the cycle
+  // count are read on the same CPU
+  uint32_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+  uint32_t now = ESP.getCycleCount();
+  TraceRing &ring = traceRings[xPortGetCoreID()];
+  if (!ring.anchored || (uint32_t)(now - ring.anchors[ring.anchor % TRACE_ANCHORS].cycles) >= TRACE_ANCHOR_CYCLES) {
+    if (ring.anchored) ++ring.anchor;
+    TraceAnchor &a = ring.anchors[ring.anchor % TRACE_ANCHORS];
+    a.us = esp_timer_get_time();
+    a.cycles = now;
+    ring.anchored = true;
+  }
+  uint32_t n = ring.next.load(std::memory_order_relaxed);
+  TraceEvent &e = ring.events[n & (TRACE_BUFFER_EVENTS - 1)];
+  e.name = name;
+  e.cycles = now;
+  e.task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+  e.anchor = ring.anchor;
+  e.phase = phase;
+  ring.next.store(n + 1, std::memory_order_release);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+}
+
+class TraceScope {
+public:
+  explicit TraceScope(const char *name) : name(name) { traceRecord(name, 'B'); }
+  ~TraceScope() { traceRecord(name, 'E'); }
+
+private:
+  const char *name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_BEGIN(name) traceRecord(name, 'B')
+#define TRACE_END(name) traceRecord(name, 'E')
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+// Time a batch of empty begin/end pairs so the dump can report what one
+// traced scope costs on this board and clock.
+void traceBegin() {
+  const int rounds = 256;
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < rounds; ++i) {
+    traceRecord("trace.calibrate", 'B');
+    traceRecord("trace.calibrate", 'E');
+  }
+  traceOverheadCycles = (ESP.getCycleCount() - start) / rounds;
+  for (int c = 0; c < portNUM_PROCESSORS; ++c) traceRings[c].next.store(0);
+}
+
+// Event time in microseconds since boot, or -1 if its anchor was reused.
+// The CPU clock is held at its maximum while tracing (see power_helper.h).
+double traceEventUs(const TraceRing &ring, const TraceEvent &e, uint32_t mhz) {
+  if ((uint16_t)(ring.anchor - e.anchor) >= TRACE_ANCHORS) return -1;
+  const TraceAnchor &a = ring.anchors[e.anchor % TRACE_ANCHORS];
+  return (double)a.us + (double)(uint32_t)(e.cycles - a.cycles) / mhz;
+}
+
+// Where a /trace dump has got to. The dump is sent in chunks while both
+// cores keep tracing, so it only covers events recorded before the request.
+struct TraceDump {
+  uint32_t pos[portNUM_PROCESSORS];
+  uint32_t end[portNUM_PROCESSORS];
+  TraceEvent head[portNUM_PROCESSORS];  // next event of each ring, copied out
+  double headUs[portNUM_PROCESSORS];
+  bool haveHead[portNUM_PROCESSORS];
+  uint32_t mhz;
+  uint32_t sent;
+  uint32_t dropped;  // overwritten before they could be sent
+  uint8_t stage;     // 0 header, 1 events, 2 footer, 3 done
+};
+
+// Copy event `pos` out of the ring. False if the core has already reused
+// its slot, or may be writing it right now.
+bool traceCopyEvent(const TraceRing &ring, uint32_t pos, TraceEvent &out) {
+  out = ring.events[pos & (TRACE_BUFFER_EVENTS - 1)];
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return ring.next.load(std::memory_order_relaxed) - pos < TRACE_BUFFER_EVENTS;
+}
+
+// Core whose next event is the earliest, or -1 when all rings are done.
+// Each ring is already in time order.
+int traceNextCore(TraceDump &d) {
+  int core = -1;
+  for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+    while (!d.haveHead[c] && d.pos[c] != d.end[c]) {
+      double us = -1;
+      if (traceCopyEvent(traceRings[c], d.pos[c], d.head[c])) us = traceEventUs(traceRings[c], d.head[c], d.mhz);
+      if (us < 0) {
+        ++d.pos[c];
+        ++d.dropped;
+        continue;
+      }
+      d.headUs[c] = us;
+      d.haveHead[c] = true;
+    }
+    if (d.haveHead[c] && (core < 0 || d.headUs[c] < d.headUs[core])) core = c;
+  }
+  return core;
+}
+
+size_t traceDumpFill(TraceDump &d, uint8_t *buf, size_t maxLen) {
+  size_t out = 0;
+  for (;;) {
+    char line[160];
+    int n;
+    int core = -1;
+    if (d.stage == 0) {
+      n = snprintf(line, sizeof(line),
+                   "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"cpuMhz\":%u,\"overheadCycles\":%u},\"traceEvents\":[",
+                   (unsigned)d.mhz, (unsigned)traceOverheadCycles);
+    } else if (d.stage == 1) {
+      core = traceNextCore(d);
+      if (core < 0) {
+        d.stage = 2;
+        continue;
+      }
+      const TraceEvent &e = d.head[core];
+      n = snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"core\":%d}}",
+                   d.sent ? "," : "", e.name, e.phase, (unsigned)e.task, d.headUs[core], core);
+    } else if (d.stage == 2) {
+      n = snprintf(line, sizeof(line), "],\"droppedEvents\":%u}", (unsigned)d.dropped);
+    } else {
+      break;
+    }
+    if (n >= (int)sizeof(line)) n = sizeof(line) - 1;
+    if (out + n > maxLen) break;  // rest goes in the next chunk
+    memcpy(buf + out, line, n);
+    out += n;
+    if (core >= 0) {
+      d.haveHead[core] = false;
+      ++d.pos[core];
+      ++d.sent;
+    } else {
+      ++d.stage;
+    }
+  }
+  if (out > 0) return out;
+  return d.stage == 3 ? 0 : RESPONSE_TRY_AGAIN;  // 0 ends the response
+}
+
+// /trace - dump both rings in Chrome trace_event format
+// (load the file in chrome://tracing or ui.perfetto.dev)
+//
+// Everything goes in one process with the task as the thread, merged in
+// time order, so a scope that begins on one core and ends on the other
+// still pairs up. The core is kept in args. Sent as a chunked response
+// so the dump never has to fit in RAM.
+void setupTraceRoutes(AsyncWebServer &server) {
+  server.on("/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+    TraceDump dump = {};
+    dump.mhz = getCpuFrequencyMhz();
+    for (int c = 0; c < portNUM_PROCESSORS; ++c) {
+      dump.end[c] = traceRings[c].next.load(std::memory_order_acquire);
+      // The oldest slot is the next one a core writes, so skip it
+      dump.pos[c] = dump.end[c] < TRACE_BUFFER_EVENTS ? 0 : dump.end[c] - (TRACE_BUFFER_EVENTS - 1);
+    }
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      [dump](uint8_t *buf, size_t maxLen, size_t) mutable -> size_t {
+        return traceDumpFill(dump, buf, maxLen);
+      });
+    request->send(response);
+  });
+}
+
+#else
+
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+
+inline void traceBegin() {}
+template <typename Server> inline void setupTraceRoutes(Server &) {}
+
+#endif
+
+#endif
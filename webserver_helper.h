@@ -4,6 +4,7 @@
 #include "config.h"              // ⬅️ Add this first to get MAX_LIGHTS etc
 #include "storage_helper.h"     // ⬅️ This gives us lightNames[] and NUM_LIGHTS
 #include "wifi_helper.h"
+#include "rtc_state.h"
 #include <ESPAsyncWebServer.h>
 
 String cachedSSIDOptions = "";
@@ -235,9 +236,9 @@ void setupWebRoutes(AsyncWebServer &server) {
       return;
     }
 
-    Serial.println("Received WiFi credentials:");
-    Serial.println("SSID: " + ssid);
-    Serial.println("Password: " + password);
+    LOG_I("Received WiFi credentials:");
+    LOG_I("SSID: %s", ssid.c_str());
+    LOG_D("Password: %s", password.c_str());
 
     saveCredentials(ssid, password);
     connectToWiFi(ssid, password);
@@ -317,7 +318,7 @@ void setupWebRoutes(AsyncWebServer &server) {
       <script>
         function updateLightInputs() {
           const count = parseInt(document.querySelector("select[name='numLights']").value);
-          for (let i = 0; i < 4; i++) {
+          for (let i = 0; i < )rawliteral" + String(MAX_LIGHTS) + R"rawliteral(; i++) {
             const group = document.getElementById("lightGroup" + i);
             if (i < count) {
               group.style.display = "block";
@@ -376,6 +377,7 @@ void setupWebRoutes(AsyncWebServer &server) {
   // /saveConfig - Save configuration
   server.on("/saveConfig", HTTP_GET, [](AsyncWebServerRequest *request) {
     preferences.begin("config", false);
+    preferences.putUInt("version", configVersion + 1);
 
     if (request->hasParam("device")) {
       String newDevice = request->getParam("device")->value();
@@ -433,7 +435,7 @@ void setupWebRoutes(AsyncWebServer &server) {
     // Restart the device after 3 seconds
     request->redirect("/");
     delay(3000);
-    ESP.restart();
+    warmRestart(BOOT_SAVE_CONFIG);
   });
 
 }
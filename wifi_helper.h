@@ -2,6 +2,7 @@
 #define WIFI_HELPER_H
 
 #include <WiFi.h>
+#include "log_helper.h"
 
 const char *ap_ssid = "Smart Light";
 const char *ap_password = "12345678";
@@ -16,29 +17,26 @@ void setupAP() {
   WiFi.mode(WIFI_AP);
   WiFi.softAP(ap_ssid, ap_password);
   WiFi.softAPConfig(local_ip, gateway, subnet);
-  Serial.print("AP IP address: ");
-  Serial.println(WiFi.softAPIP());
+  LOG_I("AP IP address: %s", WiFi.softAPIP().toString().c_str());
 }
 
 void connectToWiFi(const String &ssid, const String &password) {
   WiFi.mode(WIFI_STA);
   WiFi.begin(ssid.c_str(), password.c_str());
-  Serial.println("Connecting to WiFi...");
+  LOG_I("Connecting to WiFi...");
 
   unsigned long startAttemptTime = millis();
   const unsigned long timeout = 10000; // 10 seconds
 
   while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < timeout) {
     delay(500);
-    Serial.print(".");
   }
-  Serial.println();
 
   if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("WiFi connected!");
-    Serial.println("IP address: " + WiFi.localIP().toString());
+    LOG_I("WiFi connected!");
+    LOG_I("IP address: %s", WiFi.localIP().toString().c_str());
   } else {
-    Serial.println("Failed to connect. Falling back to AP mode.");
+    LOG_W("Failed to connect. Falling back to AP mode.");
     setupAP();
   }
 }